@@ -0,0 +1,42 @@
+#include "boot.hpp"
+#include "usb_dev.h"
+
+
+uint32_t bootTimes[BOOT_PHASES];
+
+const char* bootPhaseNames[BOOT_PHASES] = {
+  "setup",
+  "usb ready",
+  "fs mount",
+  "config read",
+  "config parse",
+  "hardware init",
+  "first loop",
+  "deferred init"
+};
+
+
+void bootMark(const int phase) {
+  if (bootTimes[phase] == 0) bootTimes[phase] = micros();
+}
+
+void bootCheckUSB() {
+  if (usb_configuration) bootMark(BOOT_USB);
+}
+
+uint32_t bootTime(const int phase) {
+  return bootTimes[phase];
+}
+
+void printBootTimeline() {
+  for (int i = 0; i < BOOT_PHASES; i++) {
+    Serial.print(bootPhaseNames[i]);
+    Serial.print(F(": "));
+    if (bootTimes[i] == 0) {
+      Serial.println(F("-"));
+    } else {
+      Serial.print(bootTimes[i]);
+      Serial.println(F(" us"));
+    }
+  }
+}
\ No newline at end of file
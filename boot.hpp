@@ -0,0 +1,28 @@
+#ifndef boot_h
+#define boot_h
+
+#include <Arduino.h>
+
+
+#define BOOT_SETUP 0 // setup() entered
+#define BOOT_USB 1 // Host configured the USB device
+#define BOOT_FS_MOUNT 2 // LittleFS mounted
+#define BOOT_CONFIG_READ 3 // Config file read into memory
+#define BOOT_CONFIG_PARSE 4 // Config JSON deserialized
+#define BOOT_HW_INIT 5 // Inputs and default profile bindings live
+#define BOOT_FIRST_LOOP 6 // First loop() pass
+#define BOOT_DEFERRED 7 // Outputs, other profiles and diagnostics finished
+#define BOOT_PHASES 8
+
+
+// Record the time of a boot phase in micros since reset. Only the first mark of each phase is kept
+void bootMark(const int phase);
+// Mark BOOT_USB if the host has configured the USB device. Call after every boot phase, USB enumerates in parallel
+void bootCheckUSB();
+// Micros since reset when a boot phase was reached, or 0 if it hasn't been yet
+uint32_t bootTime(const int phase);
+// Print the boot timeline over serial
+void printBootTimeline();
+
+
+#endif
\ No newline at end of file
@@ -6,23 +6,23 @@ HWComponent::HWComponent(const JsonObject& json) {
   pin = json["pin"];
   id = json["id"];
 }
+HWComponent::HWComponent(const int id, const int pin) : id(id), pin(pin) {
+}
 
 HWOutput::HWOutput(const JsonObject& json) : HWComponent(json) {
 }
-
-HWInput::HWInput(const JsonObject& json) : HWComponent(json) {
+HWOutput::HWOutput(const int id, const int pin) : HWComponent(id, pin) {
 }
 
-HWLEDLight::HWLEDLight(const JsonObject& json) : HWOutput(json) {
+HWLEDLight::HWLEDLight(const JsonObject& json) : HWLEDLight(json["id"].as<int>(), json["pin"].as<int>()) {
+}
+HWLEDLight::HWLEDLight(const int id, const int pin) : HWOutput(id, pin) {
   pinMode(pin, OUTPUT);
 }
 
-HWRGBLight::HWRGBLight(const JsonObject& json) : HWOutput(json) {
-  gPin = json["gpin"];
-  bPin = json["bpin"];
-  r = json["r"];
-  g = json["g"];
-  b = json["b"];
+HWRGBLight::HWRGBLight(const JsonObject& json) : HWRGBLight(json["id"].as<int>(), json["pin"].as<int>(), json["gpin"].as<int>(), json["bpin"].as<int>(), json["r"].as<int>(), json["g"].as<int>(), json["b"].as<int>()) {
+}
+HWRGBLight::HWRGBLight(const int id, const int rPin, const int gPin, const int bPin, const int r, const int g, const int b) : HWOutput(id, rPin), gPin(gPin), bPin(bPin), r(r), g(g), b(b) {
   pinMode(pin, OUTPUT);
   pinMode(gPin, OUTPUT);
   pinMode(bPin, OUTPUT);
@@ -31,75 +31,447 @@ HWRGBLight::HWRGBLight(const JsonObject& json) : HWOutput(json) {
   analogWrite(bPin, b);
 }
 
-HWButton::HWButton(const JsonObject& json) : HWInput(json) {
-  detect = json["detect"];
-  debounce = json["debounce"];
-  button.setPressedState(detect);
-  button.interval(debounce);
-  button.attach(pin, INPUT_PULLUP);
+HWStrip::HWStrip(const JsonObject& json) : HWStrip(json["id"].as<int>(), json["pin"].as<int>(), json["count"].as<int>(), json["r"].as<int>(), json["g"].as<int>(), json["b"].as<int>()) {
+}
+HWStrip::HWStrip(const int id, const int pin, const int count, const uint8_t r, const uint8_t g, const uint8_t b) : HWOutput(id, pin), count(count) {
+  frame = new uint8_t[count * 3]();
+  leds = new WS2812Serial(count, new uint8_t[count * 12], frame, pin, WS2812_GRB);
+  frameMicros = count * STRIP_PIXEL_MICROS + STRIP_LATCH_MICROS;
+  if (!leds->begin()) {
+    // WS2812Serial only works on UART TX pins
+    Serial.print(F("*** LED strip pin is not a serial TX pin: "));
+    Serial.println(pin);
+    this->count = 0; // Ignore all writes so update() never sends
+    return;
+  }
+  fill(r, g, b);
+}
+void HWStrip::setPixel(const int i, const uint8_t r, const uint8_t g, const uint8_t b) {
+  if (i < 0 || i >= count) return;
+
+  // WS2812Serial's drawing buffer is always B,G,R and is reordered for the strip by show()
+  uint8_t* p = frame + i * 3;
+  if (p[0] == b && p[1] == g && p[2] == r) return;
+  p[0] = b;
+  p[1] = g;
+  p[2] = r;
+  dirty = true;
+}
+uint32_t HWStrip::getPixel(const int i) {
+  if (i < 0 || i >= count) return 0;
+
+  const uint8_t* p = frame + i * 3;
+  return ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+void HWStrip::fill(const uint8_t r, const uint8_t g, const uint8_t b) {
+  for (int i = 0; i < count; i++) setPixel(i, r, g, b);
+}
+bool HWStrip::update() {
+  // show() waits for a transfer still in progress, so only call it once the last frame is out
+  if (!dirty || sinceShow < frameMicros) return false;
+
+  leds->show();
+  sinceShow = 0;
+  dirty = false;
+  return true;
+}
+
+volatile bool pinChanged = false;
+
+// Wakes the CPU from idle, and tells the loop a scan is needed before sleeping again
+void wakeFromPin() {
+  pinChanged = true;
+}
+
+void HWButtons::init(int length) {
+  count = length;
+  ids = new int[count];
+  pins = new int[count];
+  ports = new volatile uint32_t*[count];
+  masks = new uint32_t[count];
+  detects = new uint32_t[count];
+  intervals = new uint16_t[count];
+  changedAt = new uint32_t[count];
+  flags = new uint8_t[count];
+  bindings = new int16_t[count];
+  strips = new int[count];
+  pixels = new uint16_t[count];
+}
+void HWButtons::add(int i, const JsonObject& json) {
+  ids[i] = json["id"];
+  pins[i] = json["pin"];
+  intervals[i] = json["debounce"].as<int>();
+  bindings[i] = NO_BINDING;
+  strips[i] = -1; // Resolved once outputs are initialized
+  pixels[i] = json["pixel"];
+
+  pinMode(pins[i], INPUT_PULLUP);
+  ports[i] = portInputRegister(pins[i]);
+  masks[i] = digitalPinToBitMask(pins[i]);
+  detects[i] = json["detect"].as<int>() == HIGH ? masks[i] : 0;
+
+  // Start debounced in whatever state the pin is currently in
+  flags[i] = 0;
+  if ((*ports[i] & masks[i]) == detects[i]) flags[i] = BUTTON_RAW | BUTTON_DOWN;
+  changedAt[i] = millis();
+
+  attachInterrupt(pins[i], wakeFromPin, CHANGE);
+}
+void HWButtons::scan() {
+  const uint32_t now = millis();
+  for (int i = 0; i < count; i++) {
+    uint8_t f = flags[i] & ~BUTTON_EDGES;
+    const bool raw = (*ports[i] & masks[i]) == detects[i];
+
+    if (raw != (bool)(f & BUTTON_RAW)) {
+      f ^= BUTTON_RAW;
+      changedAt[i] = now;
+    } else if (raw != (bool)(f & BUTTON_DOWN) && now - changedAt[i] >= intervals[i]) {
+      // Raw state has been stable for the debounce interval
+      f ^= BUTTON_DOWN;
+      f |= raw ? BUTTON_PRESSED : BUTTON_RELEASED;
+    }
+
+    flags[i] = f;
+  }
+}
+bool HWButtons::idle() {
+  for (int i = 0; i < count; i++) {
+    if (flags[i] != 0) return false;
+  }
+  return true;
+}
+
+#ifdef HW_QUAD_DECODERS
+// Pins that can be routed through XBAR to an ENC peripheral
+static bool isQuadPin(const int pin) {
+  switch (pin) {
+    case 0: case 1: case 2: case 3: case 4: case 5: case 7:
+    case 30: case 31: case 33: case 36: case 37:
+      return true;
+  }
+  return false;
+}
+#endif
+
+void HWEncoders::init(int length) {
+  count = length;
+  ids = new int[count];
+  pins = new int[count];
+  pin2s = new int[count];
+  #ifdef HW_QUAD_DECODERS
+  quads = new QuadEncoder*[count];
+  #endif
+  encoders = new Encoder*[count];
+  positions = new int32_t[count];
+  remainders = new int16_t[count];
+  steps = new uint8_t[count];
+  curves = new uint8_t[count];
+  accelStarts = new float[count];
+  accelMaxes = new float[count];
+  detentAt = new uint32_t[count];
+  deltas = new long[count];
+  bindings = new int16_t[count];
+}
+void HWEncoders::add(int i, const JsonObject& json) {
+  add(i, json["id"], json["pin"], json["pin2"], json["steps"] | 4, json["accel"] | ENCODER_ACCEL_NONE, json["accelstart"] | 10.0f, json["accelmax"] | 8.0f);
+}
+void HWEncoders::add(int i, int id, int pin, int pin2, int detentSteps, int curve, float accelStart, float accelMax) {
+  ids[i] = id;
+  pins[i] = pin;
+  pin2s[i] = pin2;
+  steps[i] = detentSteps < 1 ? 1 : detentSteps;
+  curves[i] = curve;
+  accelStarts[i] = accelStart <= 0 ? 1 : accelStart;
+  accelMaxes[i] = accelMax;
+
+  encoders[i] = NULL;
+  #ifdef HW_QUAD_DECODERS
+  quads[i] = NULL;
+  if (quadCount < HW_QUAD_DECODERS && isQuadPin(pins[i]) && isQuadPin(pin2s[i])) {
+    quads[i] = new QuadEncoder(++quadCount, pins[i], pin2s[i], 1); // Channels are 1-based, enable pullups
+    quads[i]->setInitConfig();
+    quads[i]->init();
+  }
+  if (quads[i] == NULL)
+  #endif
+  encoders[i] = new Encoder(pins[i], pin2s[i]);
+
+  positions[i] = read(i);
+  remainders[i] = 0;
+  detentAt[i] = micros();
+  deltas[i] = 0;
+  bindings[i] = NO_BINDING;
+}
+int32_t HWEncoders::read(int i) {
+  #ifdef HW_QUAD_DECODERS
+  if (quads[i] != NULL) return quads[i]->read();
+  #endif
+  return encoders[i]->read();
+}
+void HWEncoders::scan() {
+  const uint32_t now = micros();
+  for (int i = 0; i < count; i++) {
+    // Counters are never reset, so no counts are lost between reads
+    const int32_t position = read(i);
+    const int32_t counts = remainders[i] + (int32_t)((uint32_t)position - (uint32_t)positions[i]);
+    positions[i] = position;
+
+    const long detents = counts / steps[i];
+    remainders[i] = counts - detents * steps[i];
+    deltas[i] = detents == 0 ? 0 : accelerate(i, detents, now);
+  }
+}
+bool HWEncoders::idle() {
+  for (int i = 0; i < count; i++) {
+    if (deltas[i] != 0) return false;
+  }
+  return true;
+}
+// Scale a number of detents by the encoder's acceleration curve
+long HWEncoders::accelerate(int i, long detents, uint32_t now) {
+  const uint32_t elapsed = now - detentAt[i];
+  detentAt[i] = now;
+  if (curves[i] == ENCODER_ACCEL_NONE || elapsed == 0) return detents;
+
+  const float speed = abs(detents) * 1000000.0f / elapsed / accelStarts[i];
+  if (speed <= 1) return detents;
+
+  float multiplier = speed;
+  if (curves[i] == ENCODER_ACCEL_QUADRATIC) multiplier = speed * speed;
+  if (multiplier > accelMaxes[i]) multiplier = accelMaxes[i];
+
+  return lroundf(detents * multiplier);
+}
+
+static ADC* adc = NULL;
+
+// Sweep of the analog channels sampled by one ADC
+class ADCScan {
+  public:
+    int count = 0;
+    int current = 0;
+    volatile bool done = false; // Sweep finished, waiting to be restarted
+    uint8_t* pins;
+    volatile uint16_t** samples;
+};
+static ADCScan adcScans[2];
+
+static void adcNext(ADC_Module* module, ADCScan& scan) {
+  *scan.samples[scan.current] = module->readSingle();
+  if (++scan.current >= scan.count) {
+    // Stop at the end of a sweep so conversions don't keep waking the CPU while idle
+    scan.current = 0;
+    scan.done = true;
+    return;
+  }
+  module->startSingleRead(scan.pins[scan.current]);
+}
+static void adc0Isr() { adcNext(adc->adc0, adcScans[0]); }
+static void adc1Isr() { adcNext(adc->adc1, adcScans[1]); }
+
+void HWAnalogs::init(int length) {
+  count = length;
+  ids = new int[count];
+  pins = new int[count];
+  adcs = new uint8_t[count];
+  samples = new uint16_t[count];
+  accepted = new uint16_t[count];
+  hysteresis = new uint16_t[count];
+  steps = new uint16_t[count];
+  positions = new int16_t[count];
+  deltas = new int16_t[count];
+  bindings = new int16_t[count];
+}
+void HWAnalogs::add(int i, const JsonObject& json) {
+  add(i, json["id"], json["pin"], json["hysteresis"] | 16, json["steps"] | 128);
 }
-bool HWButton::update() {
-  bool result = button.update();
-  if (binding != NULL) {
-    if (button.pressed() && binding->action1 != NULL) binding->action1->perform();
-    else if (button.released() && binding->action2 != NULL) binding->action2->perform();
+void HWAnalogs::add(int i, int id, int pin, int sampleHysteresis, int positionCount) {
+  if (adc == NULL) adc = new ADC();
+
+  ids[i] = id;
+  pins[i] = pin;
+  hysteresis[i] = sampleHysteresis;
+  steps[i] = positionCount < 1 ? 1 : positionCount;
+  bindings[i] = NO_BINDING;
+  deltas[i] = 0;
+
+  // Balance channels between the ADCs, some pins are only connected to one of them
+  const bool on0 = adc->adc0->checkPin(pins[i]);
+  const bool on1 = adc->adc1->checkPin(pins[i]);
+  if (!on0 && !on1) {
+    // A failed conversion would stop its ADC's sweeps for every other channel, so never sample this pin
+    Serial.print(F("*** Analog pin is not an ADC pin: "));
+    Serial.println(pin);
+    adcs[i] = ANALOG_NO_ADC;
+    samples[i] = accepted[i] = 0;
+    positions[i] = 0;
+    return;
   }
+  adcs[i] = (on1 && (!on0 || adcScans[1].count < adcScans[0].count)) ? 1 : 0;
+  adcScans[adcs[i]].count++;
 
-  return result;
+  pinMode(pins[i], INPUT_DISABLE);
+  samples[i] = accepted[i] = analogRead(pins[i]) << (ANALOG_RESOLUTION - 10);
+  positions[i] = (uint32_t)accepted[i] * steps[i] >> ANALOG_RESOLUTION;
 }
+void HWAnalogs::start() {
+  if (count == 0) return;
+
+  for (int a = 0; a < 2; a++) {
+    ADCScan& scan = adcScans[a];
+    scan.pins = new uint8_t[scan.count];
+    scan.samples = new volatile uint16_t*[scan.count];
+    scan.count = 0;
+  }
+  for (int i = 0; i < count; i++) {
+    if (adcs[i] == ANALOG_NO_ADC) continue;
+    ADCScan& scan = adcScans[adcs[i]];
+    scan.pins[scan.count] = pins[i];
+    scan.samples[scan.count++] = &samples[i];
+  }
 
-HWEncoder::HWEncoder(const JsonObject& json) : HWInput(json) {
-  pin2 = json["pin2"];
-  encoder = new Encoder(pin, pin2);
+  for (int a = 0; a < 2; a++) {
+    ADC_Module* module = a == 0 ? adc->adc0 : adc->adc1;
+    if (adcScans[a].count == 0) continue;
+    module->setAveraging(ANALOG_AVERAGING);
+    module->setResolution(ANALOG_RESOLUTION);
+    module->setConversionSpeed(ADC_CONVERSION_SPEED::MED_SPEED);
+    module->setSamplingSpeed(ADC_SAMPLING_SPEED::MED_SPEED);
+    module->enableInterrupts(a == 0 ? adc0Isr : adc1Isr);
+    module->startSingleRead(adcScans[a].pins[0]);
+  }
 }
-bool HWEncoder::update() {
-  long delta = encoder->read();
-  if (delta < 3 && delta > -3) return false; // Delta must be >= |3| to activate, or else it activates 4 times per detent
-  encoder->readAndReset();
+void HWAnalogs::scan() {
+  // Restart finished sweeps on a fixed period, so conversion interrupts only wake an idle CPU once per period
+  if (sinceSweep >= ANALOG_SWEEP_MICROS) {
+    sinceSweep = 0;
+    for (int a = 0; a < 2; a++) {
+      if (!adcScans[a].done) continue;
+      adcScans[a].done = false;
+      (a == 0 ? adc->adc0 : adc->adc1)->startSingleRead(adcScans[a].pins[0]);
+    }
+  }
 
-  if (binding != NULL) {
-    if (delta < 0 && binding->action1 != NULL) binding->action1->perform();
-    if (delta > 0 && binding->action2 != NULL) binding->action2->perform();
+  for (int i = 0; i < count; i++) {
+    const uint16_t sample = samples[i];
+    if (abs(sample - accepted[i]) <= hysteresis[i]) {
+      deltas[i] = 0;
+      continue;
+    }
+    accepted[i] = sample;
+
+    const int16_t position = (uint32_t)sample * steps[i] >> ANALOG_RESOLUTION;
+    deltas[i] = position - positions[i];
+    positions[i] = position;
   }
-  lastDelta = delta;
+}
 
-  return delta != 0;
+bool HWAnalogs::idle() {
+  for (int i = 0; i < count; i++) {
+    if (deltas[i] != 0) return false;
+  }
+  return true;
 }
 
 HWDefinition::HWDefinition(const JsonObject& json) {
+  sleep = json["idle"] | true;
+
+  setPollRate(json["pollrate"] | 1000);
+
   auto comps = json["components"].as<JsonArray>();
   
+  int buttonCount = 0;
+  int encoderCount = 0;
+  int analogCount = 0;
   for (const JsonObject& j : comps) {  
     String type = j["type"];
-    if (type.equals("led")) ledCount++;
-    else if (type.equals("rgbled")) rgbCount++;
-    else if (type.equals("encoder")) encoderCount++;
+    if (type.equals("encoder")) encoderCount++;
     else if (type.equals("button")) buttonCount++;
+    else if (type.equals("slider") || type.equals("pot")) analogCount++;
   }
 
-  leds = new HWLEDLight[ledCount];
-  rgbs = new HWRGBLight[rgbCount];
-  encoders = new HWEncoder[encoderCount];
-  buttons = new HWButton[buttonCount];
+  encoders.init(encoderCount);
+  buttons.init(buttonCount);
+  analogs.init(analogCount);
 
-  int ledI = 0;
-  int rgbI = 0;
   int encoderI = 0;
+  int buttonI = 0;
+  int analogI = 0;
+  for (const JsonObject& j : comps) {
+    String type = j["type"];
+    if (type.equals("encoder")) {
+      encoders.add(encoderI++, j);
+    } else if (type.equals("button")) {
+      buttons.add(buttonI++, j);
+    } else if (type.equals("slider") || type.equals("pot")) {
+      analogs.add(analogI++, j);
+    }
+  }
+
+  analogs.start();
+}
+
+void HWDefinition::initOutputs(const JsonObject& json) {
+  auto comps = json["components"].as<JsonArray>();
+
+  int newLedCount = 0;
+  int newRgbCount = 0;
+  int newStripCount = 0;
+  for (const JsonObject& j : comps) {  
+    String type = j["type"];
+    if (type.equals("led")) newLedCount++;
+    else if (type.equals("rgbled")) newRgbCount++;
+    else if (type.equals("strip")) newStripCount++;
+  }
+
+  leds = new HWLEDLight[newLedCount];
+  rgbs = new HWRGBLight[newRgbCount];
+  strips = new HWStrip[newStripCount];
+
   int buttonI = 0;
   for (const JsonObject& j : comps) {
     String type = j["type"];
     if (type.equals("led")) {
-      leds[ledI++] = HWLEDLight(j);
+      leds[ledCount++] = HWLEDLight(j);
     } else if (type.equals("rgbled")) {
-      rgbs[rgbI++] = HWRGBLight(j);
-    } else if (type.equals("encoder")) {
-      encoders[encoderI++] = HWEncoder(j);
-    } else if (type.equals("button")) {
-      buttons[buttonI++] = HWButton(j);
+      rgbs[rgbCount++] = HWRGBLight(j);
+    } else if (type.equals("strip")) {
+      strips[stripCount++] = HWStrip(j);
+    }
+  }
+
+  // Resolve key light strip IDs to strip indices
+  for (const JsonObject& j : comps) {
+    String type = j["type"];
+    if (!type.equals("button")) continue;
+
+    const int stripID = j["strip"] | -1;
+    for (int i = 0; i < stripCount; i++) {
+      if (strips[i].id == stripID) {
+        buttons.strips[buttonI] = i;
+        break;
+      }
     }
+    buttonI++;
   }
 }
 
+void HWDefinition::setPollRate(const int rate) {
+  // Scans happen every whole number of microframes, so round to the nearest rate that can actually be kept
+  const int clamped = rate < 1 ? 1 : (rate > USB_MICROFRAMES_PER_SECOND ? USB_MICROFRAMES_PER_SECOND : rate);
+  pollInterval = (USB_MICROFRAMES_PER_SECOND + clamped / 2) / clamped;
+  pollRate = USB_MICROFRAMES_PER_SECOND / pollInterval;
+}
+
+bool HWDefinition::idle() {
+  if (!buttons.idle() || !encoders.idle() || !analogs.idle()) return false;
+  for (int i = 0; i < stripCount; i++) {
+    if (!strips[i].idle()) return false;
+  }
+  return true;
+}
+
 void LEDIdent::update() {
   if (pin >= 0) {
     if (timer > length) {
@@ -118,6 +490,31 @@ void LEDIdent::start(int ledPin) {
   digitalWrite(pin, HIGH);
 }
 
+void StripIdent::update() {
+  if (strip != NULL) {
+    if (timer > length) {
+      strip->setPixel(pixel, color >> 16, color >> 8, color);
+      strip = NULL;
+    } else if (flashTimer > flashLength) {
+      flashTimer = 0;
+      on = !on;
+      if (on) strip->setPixel(pixel, 255, 255, 255);
+      else strip->setPixel(pixel, 0, 0, 0);
+    }
+  }
+}
+void StripIdent::start(HWStrip* identStrip, int identPixel) {
+  if (strip != NULL) strip->setPixel(pixel, color >> 16, color >> 8, color);
+
+  strip = identStrip;
+  pixel = identPixel;
+  color = strip->getPixel(pixel);
+  timer = 0;
+  flashTimer = 0;
+  on = true;
+  strip->setPixel(pixel, 255, 255, 255);
+}
+
 void RGBLEDIdent::update() {
   if (rPin > 0) {
     if (timer > length) {
@@ -127,7 +524,8 @@ void RGBLEDIdent::update() {
       rPin = -1;
       gPin = -1;
       bPin = -1;
-    } else {
+    } else if (frameTimer >= IDENT_FRAME_MILLIS) {
+      frameTimer = 0;
       analogWrite(rPin, (int)((sin(timer * 2 / 1000.0) + 1) * 255));
       analogWrite(gPin, (int)((sin(timer * 2 / 1000.0 + 1.05) + 1) * 255));
       analogWrite(bPin, (int)((sin(timer * 2 / 1000.0 + 2.1) + 1) * 255));
@@ -139,4 +537,5 @@ void RGBLEDIdent::start(int r, int g, int b) {
   gPin = g;
   bPin = b;
   timer = 0;
+  frameTimer = IDENT_FRAME_MILLIS;
 }
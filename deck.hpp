@@ -2,21 +2,55 @@
 #define deck_h
 
 #include <ArduinoJson.h>
-#include <Bounce2.h>
-// https://github.com/thomasfredericks/Bounce2#
 #include <Encoder.h>
 // https://github.com/PaulStoffregen/Encoder
+#if defined(__IMXRT1062__)
+#include <QuadEncoder.h>
+// https://github.com/mjs513/Teensy-4.x-Quad-Encoder-Library
+#define HW_QUAD_DECODERS 4 // Number of i.MX RT ENC peripherals
+#endif
+#include <ADC.h>
+// https://github.com/pedvide/ADC
+#include <WS2812Serial.h>
+// https://github.com/PaulStoffregen/WS2812Serial
 #include "profile.hpp"
 
 
+#define BUTTON_RAW 0b0001 // Last raw pin reading was the pressed state
+#define BUTTON_DOWN 0b0010 // Debounced pressed state
+#define BUTTON_PRESSED 0b0100 // Became pressed during the last scan
+#define BUTTON_RELEASED 0b1000 // Became released during the last scan
+#define BUTTON_EDGES (BUTTON_PRESSED | BUTTON_RELEASED)
+
+#define NO_BINDING -1
+
+extern volatile bool pinChanged; // Set when a button pin changes, cleared before each input scan
+void wakeFromPin(); // Button pin change interrupt
+
+#define ENCODER_ACCEL_NONE 0
+#define ENCODER_ACCEL_LINEAR 1
+#define ENCODER_ACCEL_QUADRATIC 2
+
+#define ANALOG_RESOLUTION 12 // Bits per analog sample
+#define ANALOG_AVERAGING 16 // Hardware averaged conversions per sample
+#define ANALOG_NO_ADC 255 // Pin can't be read by either ADC
+#define ANALOG_SWEEP_MICROS 1000 // Period between sweeps of all analog channels
+
+#define STRIP_PIXEL_MICROS 30 // Transfer time of one WS2812 pixel
+#define STRIP_LATCH_MICROS 300 // Low time that latches a WS2812 frame
+#define IDENT_FRAME_MILLIS 20 // Refresh period of ident animations
+
+#define USB_MICROFRAMES_PER_SECOND 8000 // High speed USB microframe rate, the fastest possible HID poll rate
+
+
 // Basic definition of a hardware component
 class HWComponent {
   public:
     int id; // Unique ID
     int pin; // Primary input/output pin
-    virtual bool update() { return false; }
   protected:
     HWComponent(const JsonObject& json);
+    HWComponent(const int id, const int pin);
     HWComponent() {}
 };
 
@@ -24,6 +58,7 @@ class HWComponent {
 class HWOutput : public HWComponent {
   protected:
     HWOutput(const JsonObject& json);
+    HWOutput(const int id, const int pin);
     HWOutput() {}
 };
 
@@ -31,6 +66,7 @@ class HWOutput : public HWComponent {
 class HWLEDLight : public HWOutput {
   public:
     HWLEDLight(const JsonObject& json);
+    HWLEDLight(const int id, const int pin);
     HWLEDLight() {}
 };
 
@@ -38,6 +74,7 @@ class HWLEDLight : public HWOutput {
 class HWRGBLight : public HWOutput {
   public:
     HWRGBLight(const JsonObject& json);
+    HWRGBLight(const int id, const int rPin, const int gPin, const int bPin, const int r, const int g, const int b);
     HWRGBLight() {}
     int gPin;
     int bPin;
@@ -46,50 +83,124 @@ class HWRGBLight : public HWOutput {
     int b;
 };
 
-// Basic definition of a hardware input component
-class HWInput : public HWComponent {
+// Addressable RGB LED strip backed by a frame buffer. Frames are sent by DMA without blocking
+class HWStrip : public HWOutput {
   public:
-    Binding* binding = NULL;
-  protected:
-    HWInput(const JsonObject& json);
-    HWInput() {}
+    HWStrip(const JsonObject& json);
+    HWStrip(const int id, const int pin, const int count, const uint8_t r, const uint8_t g, const uint8_t b);
+    HWStrip() {}
+    int count; // Number of pixels
+    void setPixel(const int i, const uint8_t r, const uint8_t g, const uint8_t b);
+    uint32_t getPixel(const int i); // 0xRRGGBB
+    void fill(const uint8_t r, const uint8_t g, const uint8_t b);
+    bool update(); // Send the frame if it changed and the previous transfer finished. Returns true if a frame was sent
+    bool idle() { return !dirty; }
+  private:
+    WS2812Serial* leds;
+    uint8_t* frame; // BGR bytes, drawn into directly
+    bool dirty = false;
+    uint32_t frameMicros; // Time to transfer and latch one frame
+    elapsedMicros sinceShow;
 };
 
-// Button
-class HWButton : public HWInput {
+// All buttons, stored as parallel arrays indexed by button
+class HWButtons {
   public:
-    HWButton(const JsonObject& json);
-    HWButton() {}
-    int detect;
-    int debounce;
-    Bounce2::Button button;
-    bool update();
+    int count = 0;
+    int* ids;
+    int* pins;
+    volatile uint32_t** ports; // GPIO input register of each pin
+    uint32_t* masks; // GPIO register bit of each pin
+    uint32_t* detects; // Masked register value when pressed
+    uint16_t* intervals; // Debounce interval in millis
+    uint32_t* changedAt; // Millis of the last raw state change
+    uint8_t* flags; // BUTTON_* state and edge flags
+    int16_t* bindings; // Index into the current profile's bindings, or NO_BINDING
+    int* strips; // Index of the strip holding this button's key light, or -1
+    uint16_t* pixels; // Pixel of the key light in its strip
+    void init(int length);
+    void add(int i, const JsonObject& json);
+    void scan(); // Debounce all buttons and set edge flags
+    bool idle(); // No button is pressed, bouncing or changed
 };
 
-// Rotary encoder
-class HWEncoder : public HWInput {
+// All rotary encoders, stored as parallel arrays indexed by encoder
+// Encoders on ENC capable pins are decoded in hardware, the rest fall back to the interrupt driven Encoder library
+class HWEncoders {
   public:
-    HWEncoder(const JsonObject& json);
-    HWEncoder() {}
-    int pin2;
-    int lastDelta = 0;
-    Encoder* encoder;
-    bool update();
+    int count = 0;
+    int* ids;
+    int* pins;
+    int* pin2s;
+    #ifdef HW_QUAD_DECODERS
+    QuadEncoder** quads; // Hardware decoder, or NULL if this encoder uses the fallback
+    int quadCount = 0;
+    #endif
+    Encoder** encoders; // Interrupt driven fallback, or NULL if this encoder uses a hardware decoder
+    int32_t* positions; // Last read position
+    int16_t* remainders; // Counts read but not yet making up a full detent
+    uint8_t* steps; // Counts per detent
+    uint8_t* curves; // ENCODER_ACCEL_* curve
+    float* accelStarts; // Detents per second where acceleration begins
+    float* accelMaxes; // Maximum action multiplier
+    uint32_t* detentAt; // Micros of the last detent
+    long* deltas; // Signed number of actions to perform from the last scan, 0 if the encoder did not activate
+    int16_t* bindings; // Index into the current profile's bindings, or NO_BINDING
+    void init(int length);
+    void add(int i, const JsonObject& json);
+    void add(int i, int id, int pin, int pin2, int detentSteps, int curve, float accelStart, float accelMax);
+    void scan(); // Read all encoders and set deltas
+    bool idle(); // No encoder activated in the last scan
+  private:
+    int32_t read(int i);
+    long accelerate(int i, long detents, uint32_t now);
+};
+
+// All analog inputs (sliders, pots), stored as parallel arrays indexed by input
+// Channels are sampled in background sweeps, each conversion complete interrupt chaining the next conversion
+class HWAnalogs {
+  public:
+    int count = 0;
+    int* ids;
+    int* pins;
+    uint8_t* adcs; // Which ADC samples the pin, or ANALOG_NO_ADC
+    volatile uint16_t* samples; // Latest hardware averaged sample, written from interrupts
+    uint16_t* accepted; // Last sample that moved further than the hysteresis
+    uint16_t* hysteresis; // Minimum sample change to accept
+    uint16_t* steps; // Number of positions across the full range
+    int16_t* positions; // Current position
+    int16_t* deltas; // Position change from the last scan
+    int16_t* bindings; // Index into the current profile's bindings, or NO_BINDING
+    void init(int length);
+    void add(int i, const JsonObject& json);
+    void add(int i, int id, int pin, int sampleHysteresis, int positionCount);
+    void start(); // Begin background sampling
+    void scan(); // Apply hysteresis to the latest samples and set deltas
+    bool idle(); // No analog input moved in the last scan
+  private:
+    elapsedMicros sinceSweep;
 };
 
 // A complete hardware definition of all components
 class HWDefinition {
   public:
-    HWDefinition(const JsonObject& json);
+    HWDefinition(const JsonObject& json); // Initializes inputs only, so they can be serviced as early as possible
     HWDefinition() {}
+    void initOutputs(const JsonObject& json); // Initializes LEDs and strips
+    void setPollRate(const int rate);
     int ledCount = 0;
     int rgbCount = 0;
-    int buttonCount = 0;
-    int encoderCount = 0;
+    int stripCount = 0;
     HWLEDLight* leds; // Array of LEDs
     HWRGBLight* rgbs; // Array of RGB LEDs
-    HWButton* buttons; // Array of buttons
-    HWEncoder* encoders; // Array of encoders
+    HWStrip* strips; // Array of addressable LED strips
+    HWButtons buttons;
+    HWEncoders encoders;
+    HWAnalogs analogs;
+    bool sleep = true; // Sleep between interrupts while idle
+    int pollRate = 1000; // Input scans/HID reports per second, as rounded by setPollRate()
+    uint32_t pollInterval = 8; // USB microframes between input scans
+    bool idle(); // No input activity and no pending output
 };
 
 class LEDIdent {
@@ -101,6 +212,7 @@ class LEDIdent {
     }
     void update();
     void start(int ledPin);
+    bool active() { return pin >= 0; }
   private:
     unsigned long int length = 3000;
     unsigned long int flashLength = 250;
@@ -109,18 +221,41 @@ class LEDIdent {
     int pin = -1;
 };
 
+class StripIdent {
+  public:
+    StripIdent() {}
+    StripIdent(unsigned long int lengthMillis, unsigned long int flashMillis) {
+      length = lengthMillis;
+      flashLength = flashMillis;
+    }
+    void update();
+    void start(HWStrip* identStrip, int identPixel);
+    bool active() { return strip != NULL; }
+  private:
+    unsigned long int length = 3000;
+    unsigned long int flashLength = 250;
+    elapsedMillis timer;
+    elapsedMillis flashTimer;
+    HWStrip* strip = NULL;
+    int pixel = -1;
+    uint32_t color; // Pixel colour to restore when finished
+    bool on = false;
+};
+
 class RGBLEDIdent {
   public:
     RGBLEDIdent() {}
     RGBLEDIdent(unsigned long int lengthMillis) { length = lengthMillis; }
     void update();
     void start(int r, int g, int b);
+    bool active() { return rPin > 0; }
   private:
     int rPin = -1;
     int gPin = -1;
     int bPin = -1;
     unsigned long int length = 3000;
     elapsedMillis timer;
+    elapsedMillis frameTimer;
 };
 
 
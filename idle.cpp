@@ -0,0 +1,33 @@
+#include "idle.hpp"
+
+
+void IdleMonitor::sleep() {
+  const uint32_t start = micros();
+  asm volatile("dsb\n\twfi");
+  wokeAt = ARM_DWT_CYCCNT;
+
+  sleptMicros += micros() - start;
+  sleeps++;
+  woke = true;
+}
+
+void IdleMonitor::inputsUpdated() {
+  if (!woke) return;
+  woke = false;
+
+  const uint32_t cycles = ARM_DWT_CYCCNT - wokeAt;
+  if (cycles > wakeCycles) wakeCycles = cycles;
+}
+
+void IdleMonitor::reset() {
+  windowStart = micros();
+  sleptMicros = 0;
+  sleeps = 0;
+  wakeCycles = 0;
+}
+
+uint32_t IdleMonitor::idlePercent() {
+  const uint32_t window = micros() - windowStart;
+  if (window == 0) return 0;
+  return (uint32_t)(sleptMicros * 100 / window);
+}
\ No newline at end of file
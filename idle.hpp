@@ -0,0 +1,30 @@
+#ifndef idle_h
+#define idle_h
+
+#include <Arduino.h>
+
+
+/*
+Sleeps the CPU on WFI while the deck is idle and keeps statistics on how long it slept.
+
+Any interrupt wakes the CPU: button pin changes, encoder edges, USB traffic, or the 1 ms
+SysTick that also paces animations. Sleeping therefore never delays a report by more than
+one USB frame.
+*/
+class IdleMonitor {
+  public:
+    void sleep(); // Wait for the next interrupt
+    void inputsUpdated(); // Call after inputs are handled, records wake-to-input latency
+    void reset(); // Start a new measurement window
+    uint32_t sleeps = 0; // Number of times slept this window
+    uint32_t wakeCycles = 0; // Longest time from waking to handling inputs this window
+    uint32_t idlePercent(); // Percent of this window spent asleep
+  private:
+    uint32_t windowStart = 0; // Micros
+    uint64_t sleptMicros = 0;
+    uint32_t wokeAt = 0;
+    bool woke = false;
+};
+
+
+#endif
\ No newline at end of file
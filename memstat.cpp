@@ -0,0 +1,75 @@
+#include "memstat.hpp"
+#include <malloc.h>
+
+
+extern unsigned long _ebss; // End of static data in RAM1, stack grows down towards it
+extern unsigned long _estack; // Top of the stack
+extern unsigned long _heap_start; // Heap in RAM2
+extern unsigned long _heap_end;
+extern char* __brkval; // Current end of the heap
+
+// configure_cache() makes the first 32 bytes above _ebss a NOACCESS MPU region to catch stack overflow
+#define STACK_GUARD_WORDS 8
+
+int subsystemUsed[MEM_SUBSYSTEMS];
+int subsystemPeak[MEM_SUBSYSTEMS];
+MemScope* currentScope = NULL;
+
+
+MemScope::MemScope(const int subsystem) {
+  tag = subsystem;
+  start = heapUsed();
+  parent = currentScope;
+  currentScope = this;
+}
+
+MemScope::~MemScope() {
+  const int delta = heapUsed() - start;
+  subsystemUsed[tag] += delta - childBytes;
+  if (subsystemUsed[tag] > subsystemPeak[tag]) subsystemPeak[tag] = subsystemUsed[tag];
+
+  if (parent != NULL) parent->childBytes += delta;
+  currentScope = parent;
+}
+
+void MemScope::sample() {
+  const int used = subsystemUsed[tag] + heapUsed() - start - childBytes;
+  if (used > subsystemPeak[tag]) subsystemPeak[tag] = used;
+}
+
+// Lowest stack address that can be accessed
+static uint32_t* stackBottom() {
+  return (uint32_t*)&_ebss + STACK_GUARD_WORDS;
+}
+
+void paintStack() {
+  uint32_t* p = stackBottom();
+  uint32_t* sp = (uint32_t*)__builtin_frame_address(0) - 64; // Leave room for this frame
+  while (p < sp) *p++ = STACK_PAINT;
+}
+
+int heapUsed() {
+  return mallinfo().uordblks;
+}
+
+int heapFree() {
+  return ((char*)&_heap_end - __brkval) + mallinfo().fordblks;
+}
+
+int stackUsed() {
+  const uint32_t* p = stackBottom();
+  while (p < (const uint32_t*)&_estack && *p == STACK_PAINT) p++;
+  return (char*)&_estack - (char*)p;
+}
+
+int stackSize() {
+  return (char*)&_estack - (char*)stackBottom();
+}
+
+int memUsed(const int subsystem) {
+  return subsystemUsed[subsystem];
+}
+
+int memPeak(const int subsystem) {
+  return subsystemPeak[subsystem];
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef memstat_h
+#define memstat_h
+
+#include <Arduino.h>
+
+
+#define MEM_CONFIG 0 // Hardware definition, profiles, bindings and actions
+#define MEM_SERIAL 1 // Serial message buffers
+#define MEM_SUBSYSTEMS 2
+
+#define STACK_PAINT 0xA5A5A5A5
+
+
+/*
+Attributes heap allocations made while in scope to a subsystem.
+
+Scopes nest: allocations made by an inner scope are only counted for the inner subsystem.
+*/
+class MemScope {
+  public:
+    MemScope(const int subsystem);
+    ~MemScope();
+    void sample(); // Update the subsystem's peak with allocations made so far in this scope
+  private:
+    int tag;
+    int start; // Heap bytes in use when the scope opened
+    int childBytes = 0; // Bytes retained by nested scopes
+    MemScope* parent;
+};
+
+// Fill unused stack with STACK_PAINT so the high-water mark can be found later. Call first thing in setup()
+void paintStack();
+
+int heapUsed();
+int heapFree(); // Free heap, including freed blocks and never used heap
+int stackUsed(); // Stack high-water mark
+int stackSize(); // Stack and unused RAM1 above static data
+int memUsed(const int subsystem); // Heap bytes currently held by a subsystem
+int memPeak(const int subsystem); // Most heap bytes ever held by a subsystem
+
+
+#endif
\ No newline at end of file
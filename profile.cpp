@@ -7,6 +7,10 @@
 #include <Mouse.h>
 
 
+void Action::perform(const int times) {
+  for (int i = 0; i < times; i++) perform();
+}
+
 Profile::Profile(const JsonObject& json) {
   const String& str = json["name"];
   const int len = str.length();
@@ -32,6 +36,7 @@ Binding::Binding(const JsonObject& json) {
   hwID = json["id"].as<int>();
   if (json.containsKey("action1")) action1 = parseAction(json["action1"].as<JsonObject>());
   if (json.containsKey("action2")) action2 = parseAction(json["action2"].as<JsonObject>());
+  report = json["report"].as<bool>();
 }
 
 StaticOutputBinding::StaticOutputBinding(const JsonObject& json) : Binding(json) { }
@@ -129,10 +134,10 @@ MouseAction::MouseAction(const JsonObject& json) : Action() {
   button = json["button"].as<int>();
 }
 void MouseAction::perform() {
-  if (moveX != 0 || moveY != 0) Mouse.move(moveX, moveY);
-  if (scrollX != 0 || scrollY != 0) Mouse.scroll(scrollY, scrollX);
-  if (press) Mouse.press(button);
-  if (release) Mouse.release(button);
+  performMouse(button, press, release, scrollX, scrollY, moveX, moveY, 1);
+}
+void MouseAction::perform(const int times) {
+  performMouse(button, press, release, scrollX, scrollY, moveX, moveY, times);
 }
 
 KeyboardAction::KeyboardAction(const JsonObject& json) : Action() {
@@ -154,28 +159,20 @@ void KeyboardAction::perform() {
   if (print != NULL) {
     Keyboard.print(*print);
   } else {
-    // TODO pressing one button, then pressing another before releasing the first will reset the held keys of the first binding
-    // Probably want to use the individual press and release
-    // Probably also need the action to be updated every loop to deal with necessary delays for instantaneous/hotkeys/multi key actions
-    
-    Keyboard.set_key1(0);
-    Keyboard.set_key2(0);
-    Keyboard.set_key3(0);
-    Keyboard.set_key4(0);
-    Keyboard.set_key5(0);
-    Keyboard.set_key6(0);
-
-    Keyboard.set_modifier(mods);
-    Keyboard.send_now(); // Send modifiers first
-    
-    Keyboard.set_key1(keys[0]);
-    Keyboard.set_key2(keys[1]);
-    Keyboard.set_key3(keys[2]);
-    Keyboard.set_key4(keys[3]);
-    Keyboard.set_key5(keys[4]);
-    Keyboard.set_key6(keys[5]);
-    // Keyboard.set_media(uint16_t c); // TODO? This might not be supported.
-    Keyboard.send_now();
+    sendKeys(keys, mods);
+  }
+}
+void KeyboardAction::perform(const int times) {
+  if (print != NULL) {
+    for (int i = 0; i < times; i++) Keyboard.print(*print);
+    return;
+  }
+
+  // Resending the same report is not a new keystroke, so release between repeats. The last press is left held like perform()
+  static const int released[6] = {0};
+  for (int i = 0; i < times; i++) {
+    if (i > 0) sendKeys(released, 0);
+    sendKeys(keys, mods);
   }
 }
 
@@ -187,6 +184,51 @@ void InstantKeyAction::perform() {
   Keyboard.release(key);
 }
 
+void performMouse(const int button, const bool press, const bool release, const int scrollX, const int scrollY, const int moveX, const int moveY, const int times) {
+  // Scale movement into as few reports as the HID value range allows
+  int remaining = times;
+  while (remaining > 0) {
+    int n = remaining;
+    const int largest = max(max(abs(moveX), abs(moveY)), max(abs(scrollX), abs(scrollY)));
+    if (largest > 0 && largest * n > 127) n = max(127 / largest, 1);
+    remaining -= n;
+
+    if (moveX != 0 || moveY != 0) Mouse.move(moveX * n, moveY * n);
+    if (scrollX != 0 || scrollY != 0) Mouse.scroll(scrollY * n, scrollX * n);
+  }
+
+  // Clicks can't be scaled, so repeat them
+  for (int i = 0; i < times; i++) {
+    if (press) Mouse.press(button);
+    if (release) Mouse.release(button);
+  }
+}
+
+void sendKeys(const int* keys, const int mods) {
+  // TODO pressing one button, then pressing another before releasing the first will reset the held keys of the first binding
+  // Probably want to use the individual press and release
+  // Probably also need the action to be updated every loop to deal with necessary delays for instantaneous/hotkeys/multi key actions
+  
+  Keyboard.set_key1(0);
+  Keyboard.set_key2(0);
+  Keyboard.set_key3(0);
+  Keyboard.set_key4(0);
+  Keyboard.set_key5(0);
+  Keyboard.set_key6(0);
+
+  Keyboard.set_modifier(mods);
+  Keyboard.send_now(); // Send modifiers first
+  
+  Keyboard.set_key1(keys[0]);
+  Keyboard.set_key2(keys[1]);
+  Keyboard.set_key3(keys[2]);
+  Keyboard.set_key4(keys[3]);
+  Keyboard.set_key5(keys[4]);
+  Keyboard.set_key6(keys[5]);
+  // Keyboard.set_media(uint16_t c); // TODO? This might not be supported.
+  Keyboard.send_now();
+}
+
 Action* parseAction(const JsonObject& json) {
   if (json == NULL) return NULL;
 
@@ -70,6 +70,7 @@ class Action {
   public:
     Action() {}
     virtual void perform() = 0;
+    virtual void perform(const int times); // Perform repeatedly, or once scaled by times where the action supports it
 };
 
 class Binding {
@@ -77,8 +78,9 @@ class Binding {
     Binding(const JsonObject& json);
     Binding() {}
     int hwID;
-    Action* action1;
-    Action* action2;
+    Action* action1 = NULL;
+    Action* action2 = NULL;
+    bool report = false; // Send analog values to the host
     virtual void update() {}
     virtual void start() {}
 };
@@ -165,15 +167,17 @@ class MouseAction : public Action {
     int moveX = 0;
     int moveY = 0;
     void perform();
+    void perform(const int times);
 };
 
 class KeyboardAction : public Action {
   public:
     KeyboardAction(const JsonObject& json);
-    int keys[6];
+    int keys[6] = {0};
     int mods = 0;
-    String* print;
+    String* print = NULL;
     void perform();
+    void perform(const int times);
 };
 
 class InstantKeyAction : public Action {
@@ -198,5 +202,11 @@ class Profile {
 
 Action* parseAction(const JsonObject& json);
 
+// Send mouse movement/scroll scaled by times, and press/release a button times times
+void performMouse(const int button, const bool press, const bool release, const int scrollX, const int scrollY, const int moveX, const int moveY, const int times);
+
+// Send modifiers, then up to 6 keys, replacing any keys currently held
+void sendKeys(const int* keys, const int mods);
+
 
 #endif
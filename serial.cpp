@@ -1,5 +1,6 @@
 #include "serial.hpp"
 #include "util.hpp"
+#include "memstat.hpp"
 
 
 // If both host and device are sending messages with their own id counter, there might be collisions
@@ -13,10 +14,12 @@ bool processSerial(void (*msgHandler)(const SerialMessage&), char* outputBuffer,
     char read = Serial.peek();
     if (read == SERIAL_MESSAGE_START) {
       Serial.read();  // Pop the byte, it's important
+      MemScope mem(MEM_SERIAL);
       SerialMessage msg;
       receiveSerialMessageHeader(msg);
       if (msg.length > 0) {
         msg.data = new char[msg.length]();
+        mem.sample();
         receiveSerialMessageData(msg);
       }
       msgHandler(msg);
@@ -18,6 +18,15 @@
 #define SERIAL_IDENT_ENCODER 10
 #define SERIAL_IDENT_BUTTON 11
 #define SERIAL_IDENT_RGB 12
+#define SERIAL_ANALOG_VALUE 13
+#define SERIAL_IDENT_ANALOG 14
+#define SERIAL_IDENT_STRIP 15
+#define SERIAL_REQUEST_HID_RATE 16
+#define SERIAL_RESPOND_HID_RATE 17
+#define SERIAL_REQUEST_MEMSTAT 18
+#define SERIAL_RESPOND_MEMSTAT 19
+#define SERIAL_REQUEST_BOOT 20
+#define SERIAL_RESPOND_BOOT 21
 
 #define COMMAND_CHAR '~'
 
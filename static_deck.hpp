@@ -0,0 +1,61 @@
+#ifndef static_deck_h
+#define static_deck_h
+
+#include <Arduino.h>
+#include "deck.hpp"
+#include "profile.hpp"
+
+/*
+Support for static config builds, where tools/genconfig.py turns a config.json into static_config.h.
+
+The generated header instantiates StaticButton for every button and unrolls binding dispatch into
+plain function calls, so a fixed layout skips JSON parsing, heap allocated bindings and virtual calls.
+Encoders, analog inputs and outputs keep using the runtime tables in hw, filled from constants.
+*/
+
+
+// Firmware state used by generated code
+extern HWDefinition hw;
+extern bool identMode;
+extern int currentProfile;
+void identButton(const int pin);
+void identEncoder(const int i, const long delta);
+void identAnalog(const int i);
+void reportAnalog(const int i);
+
+
+// Button with its pin, pressed state and debounce interval fixed at compile time. Scanning compiles down to a single register read
+template <uint8_t PIN, uint8_t DETECT, uint16_t DEBOUNCE> class StaticButton {
+  public:
+    static uint8_t flags; // BUTTON_* state and edge flags
+    static uint32_t changedAt; // Millis of the last raw state change
+
+    static void init() {
+      pinMode(PIN, INPUT_PULLUP);
+      flags = digitalReadFast(PIN) == DETECT ? BUTTON_RAW | BUTTON_DOWN : 0;
+      changedAt = millis();
+      attachInterrupt(PIN, wakeFromPin, CHANGE);
+    }
+
+    // Debounce the button and return its flags
+    static inline uint8_t scan(const uint32_t now) {
+      uint8_t f = flags & ~BUTTON_EDGES;
+      const bool raw = digitalReadFast(PIN) == DETECT;
+
+      if (raw != (bool)(f & BUTTON_RAW)) {
+        f ^= BUTTON_RAW;
+        changedAt = now;
+      } else if (raw != (bool)(f & BUTTON_DOWN) && now - changedAt >= DEBOUNCE) {
+        f ^= BUTTON_DOWN;
+        f |= raw ? BUTTON_PRESSED : BUTTON_RELEASED;
+      }
+
+      flags = f;
+      return f;
+    }
+};
+template <uint8_t PIN, uint8_t DETECT, uint16_t DEBOUNCE> uint8_t StaticButton<PIN, DETECT, DEBOUNCE>::flags = 0;
+template <uint8_t PIN, uint8_t DETECT, uint16_t DEBOUNCE> uint32_t StaticButton<PIN, DETECT, DEBOUNCE>::changedAt = 0;
+
+
+#endif
\ No newline at end of file
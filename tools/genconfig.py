@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+"""
+Generate static_config.h from a USBDeck config.json.
+
+Building the firmware with the generated header in the sketch folder compiles the layout and
+bindings straight into the firmware: readConfig() is skipped, every button gets its own
+StaticButton specialisation, and bindings become inline calls instead of Binding/Action objects.
+Delete static_config.h to go back to loading config.json at runtime.
+
+Usage: python3 tools/genconfig.py config.json [static_config.h]
+"""
+
+import json
+import os
+import sys
+
+
+# Must match profile.hpp and deck.hpp
+ACTION_MOUSE = 1
+ACTION_KEYBOARD = 2
+ACTION_INSTANT_KEY = 3
+ENCODER_ACCEL_NONE = 0
+
+MODIFIERS = [
+    ("ctrl", "MODIFIERKEY_CTRL"),
+    ("shift", "MODIFIERKEY_SHIFT"),
+    ("alt", "MODIFIERKEY_ALT"),
+    ("gui", "MODIFIERKEY_GUI"),
+]
+
+
+def c_bool(value):
+    return "true" if value else "false"
+
+
+def c_float(value):
+    return repr(float(value)) + "f"
+
+
+def c_string(text):
+    escaped = text.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n").replace("\r", "\\r").replace("\t", "\\t")
+    return "\"" + escaped + "\""
+
+
+def button_type(comp):
+    return "StaticButton<%d, %d, %d>" % (comp["pin"], comp.get("detect", 0), comp.get("debounce", 0))
+
+
+def components(hardware, *types):
+    return [c for c in hardware.get("components", []) if c.get("type") in types]
+
+
+def repeat(code, times):
+    """Wrap statements so they run times times, where times is a C expression."""
+    if times == "1":
+        return code
+    return ["for (int n = 0; n < %s; n++) {" % times] + ["  " + line for line in code] + ["}"]
+
+
+def action_code(action, times):
+    """C++ statements performing an action, times is a C expression."""
+    if not action:
+        return []
+
+    kind = action.get("type")
+    if kind == ACTION_MOUSE:
+        return ["performMouse(%d, %s, %s, %d, %d, %d, %d, %s);" % (
+            action.get("button", 0), c_bool(action.get("press")), c_bool(action.get("release")),
+            action.get("scrollx", 0), action.get("scrolly", 0),
+            action.get("movex", 0), action.get("movey", 0), times)]
+
+    if kind == ACTION_KEYBOARD:
+        if "keys" in action:
+            keys = (list(action["keys"]) + [0] * 6)[:6]
+            mods = " | ".join(name for key, name in MODIFIERS if action.get(key)) or "0"
+            return ["{",
+                    "  static const int keys[6] = { %s };" % ", ".join(str(k) for k in keys)] + \
+                ["  " + line for line in repeat(["sendKeys(keys, %s);" % mods], times)] + \
+                ["}"]
+        if "print" in action:
+            return repeat(["Keyboard.print(F(%s));" % c_string(action["print"])], times)
+        return []
+
+    if kind == ACTION_INSTANT_KEY:
+        key = action.get("key", 0)
+        return repeat(["Keyboard.press(%d);" % key, "Keyboard.release(%d);" % key], times)
+
+    return []
+
+
+def indent(lines, depth):
+    return ["  " * depth + line for line in lines]
+
+
+def binding_dispatch(profiles, hw_id, make_code):
+    """Switch over profiles, make_code(binding) returns the statements for a profile's binding."""
+    cases = []
+    for index, profile in enumerate(profiles):
+        for binding in profile.get("bindings", []):
+            if binding.get("id") == hw_id:
+                code = make_code(binding)
+                if code:
+                    cases += ["case %d:" % index] + indent(code, 1) + ["  break;"]
+                break
+
+    if not cases:
+        return []
+    return ["switch (currentProfile) {"] + indent(cases, 1) + ["}"]
+
+
+def two_way(binding, negative, positive, times_negative, times_positive):
+    code = []
+    action1 = action_code(binding.get("action1"), times_negative)
+    action2 = action_code(binding.get("action2"), times_positive)
+    if action1:
+        code += ["if (%s) {" % negative] + indent(action1, 1) + ["}"]
+    if action2:
+        if code:
+            code[-1] = "} else if (%s) {" % positive
+        else:
+            code += ["if (%s) {" % positive]
+        code += indent(action2, 1) + ["}"]
+    return code
+
+
+def generate(config, source_name):
+    hardware = config.get("hardware", {})
+    profiles = config.get("profiles", [])
+    buttons = components(hardware, "button")
+    encoders = components(hardware, "encoder")
+    analogs = components(hardware, "slider", "pot")
+    leds = components(hardware, "led")
+    rgbs = components(hardware, "rgbled")
+    strips = components(hardware, "strip")
+    strip_index = {s.get("id"): i for i, s in enumerate(strips)}
+
+    out = [
+        "// Generated by tools/genconfig.py from %s, do not edit" % source_name,
+        "#ifndef static_config_h",
+        "#define static_config_h",
+        "",
+        "#define USBDECK_STATIC_CONFIG",
+        "#include \"static_deck.hpp\"",
+        "",
+        "#define STATIC_BUTTON_COUNT %d" % len(buttons),
+        "",
+        "",
+        "// Profile colours, used to restore key lights",
+        "static const uint8_t staticProfileColours[%d][3] = {" % max(len(profiles), 1),
+    ]
+    colours = [(p.get("r", 0), p.get("g", 0), p.get("b", 0)) for p in profiles] or [(0, 0, 0)]
+    out += ["  { %d, %d, %d }," % c for c in colours]
+    out += ["};", ""]
+
+    # Inputs
+    out += ["// Create all input components", "inline void staticInitInputs() {"]
+    out += ["  hw.sleep = %s;" % c_bool(hardware.get("idle", True))]
+    out += ["  hw.setPollRate(%d);" % hardware.get("pollrate", 1000)]
+    out += ["  %s::init();" % button_type(b) for b in buttons]
+    out += ["  hw.encoders.init(%d);" % len(encoders)]
+    for i, e in enumerate(encoders):
+        out += ["  hw.encoders.add(%d, %d, %d, %d, %d, %d, %s, %s);" % (
+            i, e.get("id", 0), e["pin"], e["pin2"], e.get("steps", 4), e.get("accel", ENCODER_ACCEL_NONE),
+            c_float(e.get("accelstart", 10)), c_float(e.get("accelmax", 8)))]
+    out += ["  hw.analogs.init(%d);" % len(analogs)]
+    for i, a in enumerate(analogs):
+        out += ["  hw.analogs.add(%d, %d, %d, %d, %d);" % (i, a.get("id", 0), a["pin"], a.get("hysteresis", 16), a.get("steps", 128))]
+    out += ["  hw.analogs.start();", "}", ""]
+
+    # Outputs
+    out += ["// Create all output components, lit in the default profile colour", "inline void staticInitOutputs() {"]
+    out += ["  hw.leds = new HWLEDLight[%d];" % len(leds)]
+    out += ["  hw.leds[hw.ledCount++] = HWLEDLight(%d, %d);" % (l.get("id", 0), l["pin"]) for l in leds]
+    out += ["  hw.rgbs = new HWRGBLight[%d];" % len(rgbs)]
+    out += ["  hw.rgbs[hw.rgbCount++] = HWRGBLight(%d, %d, %d, %d, %d, %d, %d);" % (
+        r.get("id", 0), r["pin"], r["gpin"], r["bpin"], r.get("r", 0), r.get("g", 0), r.get("b", 0)) for r in rgbs]
+    out += ["  hw.strips = new HWStrip[%d];" % len(strips)]
+    out += ["  hw.strips[hw.stripCount++] = HWStrip(%d, %d, %d, %d, %d, %d);" % (
+        s.get("id", 0), s["pin"], s["count"], colours[0][0], colours[0][1], colours[0][2]) for s in strips]
+    out += ["}", ""]
+
+    # Input scanning and dispatch
+    out += ["// Scan all inputs and perform their bindings", "inline void staticUpdateInputs() {",
+            "  const uint32_t now = millis();", "  uint8_t f;"]
+    for b in buttons:
+        pin = b["pin"]
+        out += ["", "  f = %s::scan(now);" % button_type(b), "  if (f & BUTTON_EDGES) {",
+                "    if (identMode) {", "      identButton(%d);" % pin, "    } else {"]
+        if b.get("strip") in strip_index:
+            strip = "hw.strips[%d]" % strip_index[b["strip"]]
+            pixel = b.get("pixel", 0)
+            out += ["      if (hw.stripCount > %d) {" % strip_index[b["strip"]],
+                    "        if (f & BUTTON_PRESSED) %s.setPixel(%d, 255, 255, 255);" % (strip, pixel),
+                    "        else %s.setPixel(%d, staticProfileColours[currentProfile][0], staticProfileColours[currentProfile][1], staticProfileColours[currentProfile][2]);" % (strip, pixel),
+                    "      }"]
+        out += indent(binding_dispatch(profiles, b.get("id"), lambda bind: two_way(bind, "f & BUTTON_PRESSED", "f & BUTTON_RELEASED", "1", "1")), 3)
+        out += ["    }", "  }"]
+
+    out += ["", "  hw.encoders.scan();"]
+    for i, e in enumerate(encoders):
+        out += ["  if (hw.encoders.deltas[%d] != 0) {" % i,
+                "    const long delta = hw.encoders.deltas[%d];" % i,
+                "    if (identMode) identEncoder(%d, delta);" % i,
+                "    else {"]
+        out += indent(binding_dispatch(profiles, e.get("id"), lambda bind: two_way(bind, "delta < 0", "delta > 0", "-delta", "delta")), 3)
+        out += ["    }", "  }"]
+
+    out += ["", "  hw.analogs.scan();"]
+    for i, a in enumerate(analogs):
+        def analog_code(bind, i=i):
+            code = two_way(bind, "delta < 0", "delta > 0", "-delta", "delta")
+            if bind.get("report"):
+                code += ["reportAnalog(%d);" % i]
+            return code
+        out += ["  if (hw.analogs.deltas[%d] != 0) {" % i,
+                "    const int delta = hw.analogs.deltas[%d];" % i,
+                "    if (identMode) identAnalog(%d);" % i,
+                "    else {"]
+        out += indent(binding_dispatch(profiles, a.get("id"), analog_code), 3)
+        out += ["    }", "  }"]
+    out += ["}", ""]
+
+    # Scan only, for ~bench
+    out += ["// Scan all inputs without performing their bindings", "inline void staticScanInputs() {",
+            "  const uint32_t now = millis();"]
+    out += ["  %s::scan(now);" % button_type(b) for b in buttons]
+    out += ["  hw.encoders.scan();", "  hw.analogs.scan();", "}", ""]
+
+    # Idle check
+    flags = " | ".join("%s::flags" % button_type(b) for b in buttons) or "0"
+    out += ["// No button is pressed, bouncing or changed", "inline bool staticButtonsIdle() {",
+            "  return (%s) == 0;" % flags, "}", "", "", "#endif", ""]
+
+    return "\n".join(out)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip())
+        return 1
+
+    source = sys.argv[1]
+    target = sys.argv[2] if len(sys.argv) > 2 else os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "static_config.h")
+
+    with open(source) as f:
+        config = json.load(f)
+    with open(target, "w") as f:
+        f.write(generate(config, os.path.basename(source)))
+
+    print("Wrote " + os.path.normpath(target))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -7,12 +7,23 @@
 #include "deck.hpp"
 #include "profile.hpp"
 #include "util.hpp"
+#include "idle.hpp"
+#include "memstat.hpp"
+#include "boot.hpp"
+#if __has_include("static_config.h")
+#include "static_config.h"
+// Generated by tools/genconfig.py, replaces the config file with a compiled in layout
+#endif
+#include "usb_dev.h"
 
 #define JSON_DOC_MAX_SIZE 8192 // Probably overkill for most configurations. Really complex ones might need a higher max
 #define LITTLE_FS_SIZE 1048576 // Minimum of 131072 bytes seems to be required just to initialize LittleFS
+#define USB_FRINDEX_MASK 0x3FFF // USB1_FRINDEX counts microframes in 14 bits
+#define USB_MICROFRAME_MICROS 125
+#define HID_RATE_MICROS 200000 // Time spent sending reports when measuring the HID report rate
 
 
-void(* resetTeensy) (void) = 0; // Suspicious software reset that probably doesn't cycle memory and leaks everything instead
+#define MEMSTAT_FIELDS (5 + MEM_SUBSYSTEMS * 2) // Ints in a SERIAL_RESPOND_MEMSTAT message
 
 
 const char* configFilename = "config.json"; // Filename/path to the config file
@@ -25,15 +36,30 @@ HWDefinition hw; // Hardware definition (buttons, encoders, lights, etc.)
 LateArray<Profile> profiles;
 int currentProfile;
 bool configLoaded = false; // Is true after a config successfully loads
+char* configJson = NULL; // Config file contents, kept until deferred boot finishes since the JSON document points into it
+DynamicJsonDocument* configDoc = NULL; // Parsed config, kept until deferred boot finishes
+int bootStep = 0; // Next deferred boot step
+bool bootFinished = false;
 
 bool identMode = false; // If board is in ident mode, inputs will send an ident command to the configurator instead of performing default config binding actions
 RGBLEDIdent rgbIdent(3000);
 LEDIdent ledIdent(3000, 250);
+StripIdent stripIdent(3000, 250);
 
 elapsedMillis errorLedTimer;
 
+IdleMonitor idle; // Sleeps between interrupts when nothing is happening
+
+uint32_t lastScanFrame = 0; // USB frame index of the last input scan
+elapsedMicros sinceScan;
+uint32_t scanCount = 0; // Input scans since the last ~hidrate
+elapsedMillis scanCountTimer;
+
 
 void setup() {
+  paintStack(); // Must happen before anything else uses the stack
+  bootMark(BOOT_SETUP);
+  bootCheckUSB();
   
   pinMode(LED_BUILTIN, OUTPUT); // Built-in LED init
   digitalWrite(LED_BUILTIN, HIGH);
@@ -41,12 +67,67 @@ void setup() {
   // Calling Serial.begin is irrelevant for Teensy, as it is initialized before setup is even called.
   // Serial.begin(9600); // Baud rate is ignored for Teensy's serial  over USB
   // waitForSerial();
-  Serial.println(F("- USBDeck is starting up -"));
 
-  // Init LittleFS filesystem
+  // Only what's needed for the default profile's inputs happens here, everything else is deferred to finishBoot()
+  #ifndef USBDECK_STATIC_CONFIG
+  mountFS(); // The static build has no config to read, so the mount waits until inputs are live
+  #endif
+
+  #ifdef USBDECK_STATIC_CONFIG
+  staticInitInputs();
+  configLoaded = true;
+  bootMark(BOOT_HW_INIT);
+  bootCheckUSB();
+  #else
+  if (!readConfig()) {
+    Serial.println(F("*** Failed to load/apply config ***"));
+  }
+  #endif
+
+  digitalWrite(LED_BUILTIN, LOW); // Turn off built-in LED after setup finishes
+
+  idle.reset();
+}
+
+// Init LittleFS filesystem
+void mountFS() {
   if (!fs.begin(LITTLE_FS_SIZE)) {
     Serial.println(F("*** FAILED TO START LittleFS ***"));
   }
+  bootMark(BOOT_FS_MOUNT);
+  bootCheckUSB();
+}
+
+// Finish one deferred boot step per call, so inputs keep being serviced while the rest of the config loads
+void finishBoot() {
+  MemScope mem(MEM_CONFIG);
+
+  if (configDoc != NULL && bootStep == 0) {
+    hw.initOutputs((*configDoc)["hardware"].as<JsonObject>());
+    if (profiles.len > 0) applyCurrentProfile(); // Light the new outputs in the profile colour
+  }
+  #ifdef USBDECK_STATIC_CONFIG
+  else if (bootStep == 0) {
+    staticInitOutputs();
+  } else if (bootStep == 1) {
+    mountFS();
+  }
+  #endif
+  else if (configDoc != NULL && bootStep < profiles.len) {
+    profiles.arr[bootStep] = new Profile((*configDoc)["profiles"][bootStep].as<JsonObject>());
+  } else {
+    freeConfig();
+    printDiagnostics();
+    bootMark(BOOT_DEFERRED);
+    bootFinished = true;
+  }
+
+  bootStep++;
+}
+
+// Print startup diagnostics, deferred from setup() since they aren't needed for input
+void printDiagnostics() {
+  Serial.println(F("- USBDeck started -"));
 
   #ifdef ARDUINO_TEENSY41
   Serial.println(F("Teensy 4.1"));
@@ -58,18 +139,12 @@ void setup() {
   Serial.println(fs.usedSize());
   Serial.print(F("LittleFS Total Space: "));
   Serial.println(fs.totalSize());
-
-  if (!readConfig()) {
-    Serial.println(F("*** Failed to load/apply config ***"));
-  }
-
-  Serial.println(F("- Finished startin USBDeck -"));
-
-  digitalWrite(LED_BUILTIN, LOW); // Turn off built-in LED after setup finishes
-
 }
 
 void loop() {
+  bootMark(BOOT_FIRST_LOOP);
+  bootCheckUSB();
+
   // Flash error LED if config wasn't loaded
   if (!configLoaded && errorLedTimer > 1000) {
     digitalToggle(LED_BUILTIN);
@@ -78,54 +153,227 @@ void loop() {
 
   ledIdent.update();
   rgbIdent.update();
-
-  // Handle inputs?
-  updateInputs();
+  stripIdent.update();
+
+  // Handle inputs, once per poll interval just after the USB start of frame
+  const bool scanned = inputsDue();
+  if (scanned) {
+    pinChanged = false;
+    updateInputs();
+    idle.inputsUpdated();
+    scanCount++;
+  }
 
   // Handle serial
   doSerial();
+
+  // Continue loading whatever setup() skipped once inputs are live
+  if (!bootFinished && scanned) finishBoot();
+
+  // Push changed LED strip frames
+  for (int i = 0; i < hw.stripCount; i++) hw.strips[i].update();
+
+  // Sleep until the next interrupt if nothing is happening
+  // Passes between scans may sleep too, unless a button changed since the last scan
+  if (hw.sleep && (scanned || !pinChanged) && isIdle()) idle.sleep();
   
 }
 
 
 
+// Full system reset, so RAM is reinitialised instead of leaking everything allocated so far
+void resetTeensy() {
+  SCB_AIRCR = 0x05FA0004;
+  while (true) continue;
+}
+
+// True once the USB frame index has advanced a poll interval since the last input scan
+bool inputsDue() {
+  const uint32_t frame = USB1_FRINDEX;
+  const bool frameDue = ((frame - lastScanFrame) & USB_FRINDEX_MASK) >= hw.pollInterval;
+
+  if (!usb_configuration || !frameDue) {
+    // Fall back to a timer when there are no frames (USB not connected or suspended).
+    // While connected the timer runs a microframe late, so it only fires if FRINDEX stops advancing
+    uint32_t fallback = 1000;
+    if (usb_configuration) fallback = max(1000UL, hw.pollInterval * USB_MICROFRAME_MICROS) + USB_MICROFRAME_MICROS;
+    if (sinceScan < fallback) return false;
+  }
+
+  lastScanFrame = frame;
+  sinceScan = 0;
+  return true;
+}
+
+// Send empty mouse reports as fast as the host accepts them and return reports per second
+uint32_t measureHidRate() {
+  if (!usb_configuration) return 0; // Nothing polls the reports, so there's no rate to measure
+
+  // Reports queue up until the host polls them, so fill the queue before timing
+  for (int i = 0; i < 8; i++) Mouse.move(0, 0);
+
+  // Bounded by time, since inputs aren't serviced while measuring
+  uint32_t reports = 0;
+  const uint32_t start = micros();
+  uint32_t elapsed = 0;
+  while (elapsed < HID_RATE_MICROS) {
+    Mouse.move(0, 0);
+    reports++;
+    elapsed = micros() - start;
+  }
+
+  return (uint32_t)((uint64_t)reports * 1000000 / elapsed);
+}
+
+// True when nothing is pressed, moving, animating or waiting on serial
+bool isIdle() {
+  if (ledIdent.active() || rgbIdent.active() || stripIdent.active()) return false;
+  if (Serial.available()) return false;
+  #ifdef USBDECK_STATIC_CONFIG
+  if (!staticButtonsIdle()) return false;
+  #endif
+  return hw.idle();
+}
+
+// Read and debounce all inputs without performing anything
+void scanInputs() {
+  #ifdef USBDECK_STATIC_CONFIG
+  staticScanInputs();
+  #else
+  hw.buttons.scan();
+  hw.encoders.scan();
+  hw.analogs.scan();
+  #endif
+}
+
 // Check hardware for events
 void updateInputs() {
-  // Update buttons
-  for (int i = 0; i < hw.buttonCount; i++) {
-    HWButton& btn = hw.buttons[i];
-    
-    Binding* bind = btn.binding;
-    if (identMode) btn.binding = NULL; // TODO Probably a terrible way to make the button not perform the bound action when identifying
-    if (btn.update() && identMode) identButton(btn);
-    if (identMode) btn.binding = bind; // TODO Probably a terrible way to make the button not perform the bound action when identifying
-  }
-  for (int i = 0; i < hw.encoderCount; i++) {
-    HWEncoder& enc = hw.encoders[i];
-
-    Binding* bind = enc.binding;
-    if (identMode) enc.binding = NULL; // TODO Probably a terrible way to make the button not perform the bound action when identifying
-    if (enc.update() && identMode) identEncoder(enc, enc.lastDelta);
-    if (identMode) enc.binding = bind; // TODO Probably a terrible way to make the button not perform the bound action when identifying
+  #ifdef USBDECK_STATIC_CONFIG
+  staticUpdateInputs();
+  #else
+  scanInputs();
+
+  if (identMode) {
+    identInputs();
+    return;
+  }
+  if (profiles.len == 0) return;
+
+  const Binding* binds = profiles[currentProfile].bindings;
+
+  // Dispatch button edges
+  for (int i = 0; i < hw.buttons.count; i++) {
+    const uint8_t f = hw.buttons.flags[i];
+    if (!(f & BUTTON_EDGES)) continue;
+    if (hw.buttons.strips[i] >= 0) lightKey(i, f & BUTTON_PRESSED);
+    const int b = hw.buttons.bindings[i];
+    if (b == NO_BINDING) continue;
+
+    const Binding& bind = binds[b];
+    if (f & BUTTON_PRESSED) {
+      if (bind.action1 != NULL) bind.action1->perform();
+    } else if (bind.action2 != NULL) {
+      bind.action2->perform();
+    }
+  }
+
+  // Dispatch encoder turns
+  for (int i = 0; i < hw.encoders.count; i++) {
+    const long delta = hw.encoders.deltas[i];
+    if (delta == 0) continue;
+    const int b = hw.encoders.bindings[i];
+    if (b == NO_BINDING) continue;
+
+    const Binding& bind = binds[b];
+    if (delta < 0 && bind.action1 != NULL) bind.action1->perform(-delta);
+    if (delta > 0 && bind.action2 != NULL) bind.action2->perform(delta);
+  }
+
+  // Dispatch analog position changes
+  for (int i = 0; i < hw.analogs.count; i++) {
+    const int delta = hw.analogs.deltas[i];
+    if (delta == 0) continue;
+    const int b = hw.analogs.bindings[i];
+    if (b == NO_BINDING) continue;
+
+    const Binding& bind = binds[b];
+    if (delta < 0 && bind.action1 != NULL) bind.action1->perform(-delta);
+    if (delta > 0 && bind.action2 != NULL) bind.action2->perform(delta);
+    if (bind.report) reportAnalog(i);
+  }
+  #endif
+}
+
+// Light a button's key pixel while it is held, otherwise show the profile colour
+void lightKey(const int i, const bool pressed) {
+  if (profiles.len == 0) return;
+
+  HWStrip& strip = hw.strips[hw.buttons.strips[i]];
+  const Profile& profile = profiles[currentProfile];
+  if (pressed) strip.setPixel(hw.buttons.pixels[i], 255, 255, 255);
+  else strip.setPixel(hw.buttons.pixels[i], profile.r, profile.g, profile.b);
+}
+
+// Send the current position of an analog input to the host
+void reportAnalog(const int i) {
+  char bytes[8];
+  splitIntToBytes(hw.analogs.ids[i], bytes);
+  splitIntToBytes(hw.analogs.positions[i], bytes + 4);
+  sendSerialMessage(SERIAL_ANALOG_VALUE, 8, bytes);
+}
+
+// Send ident requests for scanned inputs instead of performing their bindings
+void identInputs() {
+  for (int i = 0; i < hw.buttons.count; i++) {
+    if (hw.buttons.flags[i] & BUTTON_EDGES) identButton(hw.buttons.pins[i]);
+  }
+  for (int i = 0; i < hw.encoders.count; i++) {
+    if (hw.encoders.deltas[i] != 0) identEncoder(i, hw.encoders.deltas[i]);
+  }
+  for (int i = 0; i < hw.analogs.count; i++) {
+    if (hw.analogs.deltas[i] != 0) identAnalog(i);
   }
 }
 
 // Send ident request for a specified encoder
-void identEncoder(const HWEncoder& encoder, int delta) {
+void identEncoder(const int i, const long delta) {
   char pinBytes[4];
-  int pin = encoder.pin;
-  if (delta > 0) pin = encoder.pin2;
+  int pin = hw.encoders.pins[i];
+  if (delta > 0) pin = hw.encoders.pin2s[i];
   splitIntToBytes(pin, pinBytes);
   sendSerialMessage(SERIAL_IDENT_ENCODER, 4, pinBytes);
 }
 
+// Send ident request for a specified analog input
+void identAnalog(const int i) {
+  char pinBytes[4];
+  splitIntToBytes(hw.analogs.pins[i], pinBytes);
+  sendSerialMessage(SERIAL_IDENT_ANALOG, 4, pinBytes);
+}
+
 // Send ident request for a specified button
-void identButton(const HWButton& button) {
+void identButton(const int pin) {
   char pinBytes[4];
-  splitIntToBytes(button.pin, pinBytes);
+  splitIntToBytes(pin, pinBytes);
   sendSerialMessage(SERIAL_IDENT_BUTTON, 4, pinBytes);
 }
 
+// Time a number of input scans and print the average cost
+// Only scanning is timed, dispatching would send real HID reports for anything that changes while benchmarking
+void benchInputs() {
+  const int passes = 10000;
+  const uint32_t start = ARM_DWT_CYCCNT;
+  for (int i = 0; i < passes; i++) scanInputs();
+  const uint32_t cycles = ARM_DWT_CYCCNT - start;
+
+  Serial.print(F("scanInputs() passes: "));
+  Serial.println(passes);
+  Serial.print(F("Cycles per pass: "));
+  Serial.println(cycles / passes);
+  Serial.print(F("Nanoseconds per pass: "));
+  Serial.println((uint32_t)((uint64_t)cycles * 1000 / passes / (F_CPU_ACTUAL / 1000000)));
+}
+
 // Utility function to write a byte array to a filepath
 bool writeStringToFile(const char* filepath, const char* bytes, const int length) {
   fs.remove(filepath);
@@ -157,11 +405,19 @@ void doSerial() {
         Serial.println(F("~clear   - Clear the config of this device and do a soft reset"));
         Serial.println(F("~fsstat  - Display filesystem usage"));
         Serial.println(F("~hwstat  - Display hardware component counts"));
+        Serial.println(F("~bench   - Measure the cost of one input scan pass"));
+        Serial.println(F("~idlestat - Display time spent asleep since the last ~idlestat"));
+        Serial.println(F("~hidrate - Measure the HID report rate the host is polling at"));
+        Serial.println(F("~memstat - Display heap, stack and per-subsystem memory usage"));
+        Serial.println(F("~boot    - Display the boot timeline"));
       } else if (strMatch(buffer + i + 1, "reset\n", 6)) {
         Serial.println(F("Resetting Teensy, this may take a few seconds..."));
         Serial.send_now();
         resetTeensy();
       } else if (strMatch(buffer + i + 1, "config\n", 7)) {
+        #ifdef USBDECK_STATIC_CONFIG
+        Serial.println(F("Config is compiled into this firmware"));
+        #else
         File cfgFile = fs.open(configFilename, FILE_READ);
         if (cfgFile) {
           const int len = cfgFile.size();
@@ -173,6 +429,7 @@ void doSerial() {
           Serial.println(F("Failed to open config file"));
         }
         cfgFile.close();
+        #endif
       } else if (strMatch(buffer + i + 1, "clear\n", 6)) {
         if (fs.remove(configFilename)) {
           Serial.println(F("Deleted config file"));
@@ -186,11 +443,60 @@ void doSerial() {
         Serial.println(fs.totalSize());
       } else if (strMatch(buffer + i + 1, "hwstat\n", 7)) {
         Serial.print(F("Buttons: "));
-        Serial.println(hw.buttonCount);
+        #ifdef USBDECK_STATIC_CONFIG
+        Serial.println(STATIC_BUTTON_COUNT);
+        #else
+        Serial.println(hw.buttons.count);
+        #endif
         Serial.print(F("Encoders: "));
-        Serial.println(hw.encoderCount);
+        Serial.println(hw.encoders.count);
+        Serial.print(F("Analogs: "));
+        Serial.println(hw.analogs.count);
         Serial.print(F("LEDs: "));
         Serial.println(hw.ledCount);
+        Serial.print(F("LED strips: "));
+        Serial.println(hw.stripCount);
+      } else if (strMatch(buffer + i + 1, "bench\n", 6)) {
+        benchInputs();
+      } else if (strMatch(buffer + i + 1, "idlestat\n", 9)) {
+        Serial.print(F("Idle sleeping: "));
+        Serial.println(hw.sleep ? F("enabled") : F("disabled"));
+        Serial.print(F("Time asleep: "));
+        Serial.print(idle.idlePercent());
+        Serial.println(F("%"));
+        Serial.print(F("Sleeps: "));
+        Serial.println(idle.sleeps);
+        Serial.print(F("Longest wake to input (us): "));
+        Serial.println(idle.wakeCycles / (F_CPU_ACTUAL / 1000000));
+        idle.reset();
+      } else if (strMatch(buffer + i + 1, "hidrate\n", 8)) {
+        Serial.print(F("Configured poll rate: "));
+        Serial.println(hw.pollRate);
+        Serial.print(F("Input scans per second: "));
+        Serial.println(scanCountTimer > 0 ? (uint32_t)((uint64_t)scanCount * 1000 / scanCountTimer) : 0);
+        Serial.print(F("Measured HID reports per second: "));
+        Serial.println(measureHidRate());
+        scanCount = 0;
+        scanCountTimer = 0;
+      } else if (strMatch(buffer + i + 1, "memstat\n", 8)) {
+        Serial.print(F("Heap used/free: "));
+        Serial.print(heapUsed());
+        Serial.print(F("/"));
+        Serial.println(heapFree());
+        Serial.print(F("Stack high-water/size: "));
+        Serial.print(stackUsed());
+        Serial.print(F("/"));
+        Serial.println(stackSize());
+        Serial.print(F("Config used/peak: "));
+        Serial.print(memUsed(MEM_CONFIG));
+        Serial.print(F("/"));
+        Serial.println(memPeak(MEM_CONFIG));
+        Serial.print(F("Serial used/peak: "));
+        Serial.print(memUsed(MEM_SERIAL));
+        Serial.print(F("/"));
+        Serial.println(memPeak(MEM_SERIAL));
+      } else if (strMatch(buffer + i + 1, "boot\n", 5)) {
+        printBootTimeline();
       }
     }
   }
@@ -200,6 +506,11 @@ void doSerial() {
 void serialMessageHandler(const SerialMessage& msg) {
   // Handle request for the current config file
   if (msg.type == SERIAL_REQUEST_CONFIG) {
+    #ifdef USBDECK_STATIC_CONFIG
+    const char* text = "Config is compiled into this firmware";
+    sendSerialMessage(SERIAL_RESPOND_ERROR, msg.id, strlen(text), text);
+    return;
+    #endif
     File cfgFile = fs.open(configFilename, FILE_READ);
     if (!cfgFile) {
       const char* text = "No config file";
@@ -217,6 +528,11 @@ void serialMessageHandler(const SerialMessage& msg) {
 
   // Host sent new config to apply
   else if (msg.type == SERIAL_CHANGE_CONFIG) {
+    #ifdef USBDECK_STATIC_CONFIG
+    const char* text = "Config is compiled into this firmware";
+    sendSerialMessage(SERIAL_RESPOND_ERROR, msg.id, strlen(text), text);
+    return;
+    #endif
     if (!writeStringToFile(configFilename, msg.data, msg.length)) {
       const char* text = "Failed to write config file";
       sendSerialMessage(SERIAL_RESPOND_ERROR, msg.id, strlen(text), text);
@@ -252,6 +568,49 @@ void serialMessageHandler(const SerialMessage& msg) {
 
     sendSerialMessage(SERIAL_RESPOND_OK, msg.id);
   }
+
+  // Memory telemetry, lets the configurator check a config will fit before sending it
+  else if (msg.type == SERIAL_REQUEST_MEMSTAT) {
+    int stats[MEMSTAT_FIELDS] = { heapUsed(), heapFree(), stackUsed(), stackSize(), JSON_DOC_MAX_SIZE };
+    for (int i = 0; i < MEM_SUBSYSTEMS; i++) {
+      stats[5 + i * 2] = memUsed(i);
+      stats[6 + i * 2] = memPeak(i);
+    }
+
+    char bytes[MEMSTAT_FIELDS * 4];
+    for (int i = 0; i < MEMSTAT_FIELDS; i++) splitIntToBytes(stats[i], bytes + i * 4);
+    sendSerialMessage(SERIAL_RESPOND_MEMSTAT, msg.id, MEMSTAT_FIELDS * 4, bytes);
+  }
+
+  // Boot timeline, micros since reset for each BOOT_* phase
+  else if (msg.type == SERIAL_REQUEST_BOOT) {
+    char bytes[BOOT_PHASES * 4];
+    for (int i = 0; i < BOOT_PHASES; i++) splitIntToBytes(bootTime(i), bytes + i * 4);
+    sendSerialMessage(SERIAL_RESPOND_BOOT, msg.id, BOOT_PHASES * 4, bytes);
+  }
+
+  // Measure the achieved HID report rate
+  else if (msg.type == SERIAL_REQUEST_HID_RATE) {
+    char bytes[8];
+    splitIntToBytes(hw.pollRate, bytes);
+    splitIntToBytes(measureHidRate(), bytes + 4);
+    sendSerialMessage(SERIAL_RESPOND_HID_RATE, msg.id, 8, bytes);
+  }
+
+  // Ident a pixel of an LED strip, identified by the strip's data pin
+  else if (msg.type == SERIAL_IDENT_STRIP) {
+    const int pin = joinBytesToInt(msg.data);
+    for (int i = 0; i < hw.stripCount; i++) {
+      if (hw.strips[i].pin == pin) {
+        stripIdent.start(&hw.strips[i], joinBytesToInt(msg.data+4));
+        sendSerialMessage(SERIAL_RESPOND_OK, msg.id);
+        return;
+      }
+    }
+
+    const char* text = "No strip on pin";
+    sendSerialMessage(SERIAL_RESPOND_ERROR, msg.id, strlen(text), text);
+  }
 }
 
 // Read config file and apply
@@ -267,36 +626,54 @@ bool readConfig() {
   return configLoaded;
 }
 
-// Read and apply hardware/bindings/profiles configuration file
+// Read config file, then apply the hardware inputs and default profile. finishBoot() applies the rest
 bool readConfigFromFile(File& cfgFile) {
+  MemScope mem(MEM_CONFIG);
+
   // Read config file
   int size = cfgFile.size();
-  char jsonStr[size];
-  cfgFile.readBytes(jsonStr, size);
+  configJson = new char[size];
+  cfgFile.readBytes(configJson, size);
   cfgFile.close();
+  bootMark(BOOT_CONFIG_READ);
+  bootCheckUSB();
 
   // Parse JSON config
-  DynamicJsonDocument doc(JSON_DOC_MAX_SIZE);
-  DeserializationError error = deserializeJson(doc, jsonStr, size);
+  configDoc = new DynamicJsonDocument(JSON_DOC_MAX_SIZE);
+  DeserializationError error = deserializeJson(*configDoc, configJson, size);
+  bootMark(BOOT_CONFIG_PARSE);
+  bootCheckUSB();
   if (error) {
     Serial.print(F("deserializeJson() failed: "));
     Serial.println(error.f_str());
+    freeConfig();
     return false;
   } else {
     // Create hardware definition
-    hw = HWDefinition(doc["hardware"].as<JsonObject>());
-    readProfiles(doc["profiles"].as<JsonArray>());
-    doc.clear();
-    doc.garbageCollect();
+    hw = HWDefinition((*configDoc)["hardware"].as<JsonObject>());
+    readProfiles((*configDoc)["profiles"].as<JsonArray>());
+    mem.sample(); // Peak includes the JSON document
+    bootMark(BOOT_HW_INIT);
+    bootCheckUSB();
     return true;
   }
 }
 
+// Free the config file contents and parsed document
+void freeConfig() {
+  delete configDoc;
+  configDoc = NULL;
+  delete[] configJson;
+  configJson = NULL;
+}
+
+// Create the default profile and apply it. The other profiles are created by finishBoot()
 void readProfiles(const JsonArray& json) {
   if (!profiles.init(json.size())) return;
 
-  for (int i = 0; i < profiles.len; i++) {
-    profiles.arr[i] = new Profile(json[i].as<JsonObject>());
+  profiles.arr[0] = new Profile(json[0].as<JsonObject>());
+  for (int i = 1; i < profiles.len; i++) {
+    profiles.arr[i] = NULL;
   }
 
   currentProfile = 0;
@@ -306,27 +683,26 @@ void readProfiles(const JsonArray& json) {
 void applyCurrentProfile() {
   const Profile& profile = profiles[currentProfile];
 
-  for (int i = 0; i < hw.buttonCount; i++) {
-    HWButton& btn = hw.buttons[i];
-    btn.binding = NULL;
-
-    for (int j = 0; j < profile.bindingCount; j++) {
-      if (profile.bindings[j].hwID == btn.id) {
-        btn.binding = &profile.bindings[j];
-        break;
-      }
-    }
+  for (int i = 0; i < hw.stripCount; i++) {
+    hw.strips[i].fill(profile.r, profile.g, profile.b);
   }
 
-  for (int i = 0; i < hw.encoderCount; i++) {
-    HWEncoder& btn = hw.encoders[i];
-    btn.binding = NULL;
+  for (int i = 0; i < hw.buttons.count; i++) {
+    hw.buttons.bindings[i] = findBinding(profile, hw.buttons.ids[i]);
+  }
+  for (int i = 0; i < hw.encoders.count; i++) {
+    hw.encoders.bindings[i] = findBinding(profile, hw.encoders.ids[i]);
+  }
+  for (int i = 0; i < hw.analogs.count; i++) {
+    hw.analogs.bindings[i] = findBinding(profile, hw.analogs.ids[i]);
+  }
+}
 
-    for (int j = 0; j < profile.bindingCount; j++) {
-      if (profile.bindings[j].hwID == btn.id) {
-        btn.binding = &profile.bindings[j];
-        break;
-      }
-    }
+// Index of the binding for a hardware ID in a profile, or NO_BINDING
+int findBinding(const Profile& profile, const int hwID) {
+  for (int j = 0; j < profile.bindingCount; j++) {
+    if (profile.bindings[j].hwID == hwID) return j;
   }
+
+  return NO_BINDING;
 }